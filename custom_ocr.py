@@ -3,11 +3,14 @@ Python wrapper for C-based OCR using ctypes
 This module provides a Python interface to the custom C OCR library
 """
 
+import io
 import os
 import ctypes
-from ctypes import c_char_p, c_void_p, c_size_t, c_float
+from ctypes import c_char_p, c_void_p, c_size_t, c_float, c_int, c_double
 import tempfile
-from typing import Optional, Tuple
+import queue
+import threading
+from typing import Iterator, List, Optional, Tuple
 import subprocess
 import logging
 
@@ -15,6 +18,199 @@ import logging
 logging.basicConfig(level=logging.INFO)
 logger = logging.getLogger(__name__)
 
+class OCRWordStruct(ctypes.Structure):
+    """Mirror of the C OCRWord structure"""
+    _fields_ = [
+        ("text", c_void_p),
+        ("confidence", c_float),
+        ("left", c_int),
+        ("top", c_int),
+        ("right", c_int),
+        ("bottom", c_int),
+    ]
+
+
+# Order of the C OCRStage enum, which indexes OCRResult.stage_ms
+OCR_STAGES = ("load", "grayscale", "crop", "rotate", "deskew", "tone",
+              "denoise", "sharpen", "scale", "language", "engine", "recognize", "postprocess")
+
+
+class OCRResultStruct(ctypes.Structure):
+    """Mirror of the C OCRResult structure"""
+    _fields_ = [
+        ("text", c_void_p),
+        ("confidence", c_float),
+        ("word_count", c_int),
+        ("character_count", c_int),
+        ("processing_time_ms", c_int),
+        ("error_code", c_int),
+        ("error_message", ctypes.c_char * 512),
+        ("processed_image", c_void_p),
+        ("image_width", c_int),
+        ("image_height", c_int),
+        ("image_depth", c_int),
+        ("mean_confidence", c_float),
+        ("words", ctypes.POINTER(OCRWordStruct)),
+        ("word_box_count", c_int),
+        ("from_cache", c_int),
+        ("stage_ms", c_double * len(OCR_STAGES)),
+        ("hocr", c_void_p),
+        ("tsv", c_void_p),
+        ("_strings", c_void_p * 2),     # OCRArena first/current
+        ("_strings_reserved", c_size_t),
+        ("_word_capacity", c_int),
+        ("blocks", ctypes.POINTER(OCRWordStruct)),
+        ("block_count", c_int),
+        ("language", ctypes.c_char * 256),
+    ]
+
+
+class OCRDocumentResultStruct(ctypes.Structure):
+    """Mirror of the C OCRDocumentResult structure"""
+    _fields_ = [
+        ("page_count", c_int),
+        ("success_count", c_int),
+        ("worker_count", c_int),
+        ("total_time_ms", c_int),
+        ("pages", ctypes.POINTER(ctypes.POINTER(OCRResultStruct))),
+    ]
+
+
+class OCRStreamEventStruct(ctypes.Structure):
+    """Mirror of the C OCRStreamEvent structure"""
+    _fields_ = [
+        ("page", c_int),
+        ("block", c_int),          # -1 for the page event
+        ("text", c_char_p),
+        ("confidence", c_float),
+        ("result", ctypes.POINTER(OCRResultStruct)),
+    ]
+
+
+# OCRErrorCode values the wrapper tells apart
+OCR_ERROR_TIMEOUT = -6           # Time budget spent; the result may hold partial text
+OCR_ERROR_CANCELLED = -11        # A stream callback stopped the document
+
+
+class OCRCacheStatsStruct(ctypes.Structure):
+    """Mirror of the C OCRCacheStats structure"""
+    _fields_ = [
+        ("hits", ctypes.c_ulong),
+        ("backend_hits", ctypes.c_ulong),
+        ("misses", ctypes.c_ulong),
+        ("stores", ctypes.c_ulong),
+        ("evictions", ctypes.c_ulong),
+        ("entries", ctypes.c_ulong),
+        ("bytes", ctypes.c_ulong),
+        ("max_bytes", ctypes.c_ulong),
+    ]
+
+
+class OCRFieldRegionStruct(ctypes.Structure):
+    """Mirror of the C OCRFieldRegion structure"""
+    _fields_ = [
+        ("left", c_int),
+        ("top", c_int),
+        ("width", c_int),
+        ("height", c_int),
+        ("whitelist", ctypes.c_char * 128),
+        ("page_seg_mode", c_int),
+    ]
+
+
+class OCRFieldResultStruct(ctypes.Structure):
+    """Mirror of the C OCRFieldResult structure"""
+    _fields_ = [
+        ("text", ctypes.c_char * 256),
+        ("confidence", c_float),
+        ("error_code", c_int),
+    ]
+
+
+# Named character sets for fields, as the CLI "fields" command accepts them
+OCR_FIELD_CHARSETS = {
+    "digits": "0123456789",
+    "amount": "0123456789.,-€$",
+    "date": "0123456789./-",
+}
+
+
+_CACHE_GET = ctypes.CFUNCTYPE(c_void_p, c_void_p, c_char_p, ctypes.POINTER(c_size_t))
+_CACHE_RELEASE = ctypes.CFUNCTYPE(None, c_void_p, c_void_p)
+_CACHE_PUT = ctypes.CFUNCTYPE(None, c_void_p, c_char_p, c_void_p, c_size_t)
+_STREAM_CALLBACK = ctypes.CFUNCTYPE(c_int, c_void_p, ctypes.POINTER(OCRStreamEventStruct))
+
+
+class RedisResultCache:
+    """
+    Second tier of the C library's result cache, shared through Redis
+    
+    Stores the library's serialized results under its own keys, so every
+    worker process and container reuses results for re-uploaded files.
+    Redis errors are logged and treated as misses; OCR never fails because
+    the cache is unreachable.
+    """
+    
+    def __init__(self, url: str, ttl_seconds: int = 7 * 24 * 3600):
+        import redis  # Optional dependency, only needed when this tier is used
+        
+        self.client = redis.Redis.from_url(url, socket_timeout=0.5, socket_connect_timeout=0.5)
+        self.ttl_seconds = ttl_seconds
+        self._lent = {}  # Buffers handed to C until it releases them
+        self._lock = threading.Lock()
+        # Kept on the instance: ctypes callbacks must outlive their registration
+        self._callbacks = (_CACHE_GET(self._get), _CACHE_RELEASE(self._release), _CACHE_PUT(self._put))
+    
+    def register(self, lib):
+        """Install this cache as the library's second tier"""
+        lib.ocr_set_cache_backend(*self._callbacks, None)
+    
+    def _get(self, user_data, key, size):
+        try:
+            value = self.client.get(key)
+        except Exception as e:
+            logger.warning(f"⚠️ Redis cache lookup failed: {e}")
+            return None
+        if not value:
+            return None
+        
+        buffer = ctypes.create_string_buffer(value, len(value))
+        address = ctypes.addressof(buffer)
+        with self._lock:
+            self._lent[address] = buffer
+        size[0] = len(value)
+        return address
+    
+    def _release(self, user_data, value):
+        with self._lock:
+            self._lent.pop(value, None)
+    
+    def _put(self, user_data, key, value, size):
+        try:
+            self.client.set(key, ctypes.string_at(value, size), ex=self.ttl_seconds)
+        except Exception as e:
+            logger.warning(f"⚠️ Redis cache store failed: {e}")
+
+
+def _buffer_pointer(image_data):
+    """
+    Pointer to the bytes of image_data without copying them
+    
+    bytes are passed as-is; writable buffers (bytearray, numpy arrays,
+    writable memoryviews) are wrapped in place. Only read-only buffers that
+    are not bytes fall back to a copy.
+    """
+    if isinstance(image_data, bytes):
+        return image_data, len(image_data)
+    
+    view = memoryview(image_data)
+    if view.readonly:
+        data = view.tobytes()
+        return data, len(data)
+    
+    return (ctypes.c_ubyte * view.nbytes).from_buffer(view), view.nbytes
+
+
 class COCRWrapper:
     """Python wrapper for C-based OCR library"""
     
@@ -40,6 +236,20 @@ class COCRWrapper:
         except OSError as e:
             logger.error(f"❌ Failed to load OCR library: {e}")
             raise
+        
+        # Results handed back to ocr_process_memory_into, one per concurrent call
+        self._result_pool = []
+        self._result_pool_lock = threading.Lock()
+        
+        self.redis_cache = None
+        redis_url = os.environ.get("REDIS_URL")
+        if redis_url:
+            self.enable_redis_cache(redis_url)
+        
+        # e.g. OCR_PRELOAD_LANGUAGES="fra+eng,eng" loads those models before the first request
+        preload = os.environ.get("OCR_PRELOAD_LANGUAGES")
+        if preload:
+            self.preload(preload, int(os.environ.get("OCR_PRELOAD_COPIES", 1)))
     
     def _setup_function_signatures(self):
         """Setup function signatures for the C library"""
@@ -58,6 +268,196 @@ class COCRWrapper:
         # ocr_free_text(char* text)
         self.lib.ocr_free_text.argtypes = [c_char_p]
         self.lib.ocr_free_text.restype = None
+        
+        # ocr_process_file_enhanced(const char* file_path, const char* language)
+        self.lib.ocr_process_file_enhanced.argtypes = [c_char_p, c_char_p]
+        self.lib.ocr_process_file_enhanced.restype = ctypes.POINTER(OCRResultStruct)
+        
+        # ocr_process_memory_detailed(const unsigned char* data, size_t size, const char* language)
+        self.lib.ocr_process_memory_detailed.argtypes = [c_void_p, c_size_t, c_char_p]
+        self.lib.ocr_process_memory_detailed.restype = ctypes.POINTER(OCRResultStruct)
+        
+        # ocr_process_pixels_detailed(pixels, width, height, stride, bits_per_pixel, language)
+        self.lib.ocr_process_pixels_detailed.argtypes = [c_void_p, c_int, c_int, c_int, c_int, c_char_p]
+        self.lib.ocr_process_pixels_detailed.restype = ctypes.POINTER(OCRResultStruct)
+        
+        # ocr_free_result(OCRResult* result)
+        self.lib.ocr_free_result.argtypes = [ctypes.POINTER(OCRResultStruct)]
+        self.lib.ocr_free_result.restype = None
+        
+        # ocr_process_document(const char* file_path, const char* language, int num_workers)
+        self.lib.ocr_process_document.argtypes = [c_char_p, c_char_p, c_int]
+        self.lib.ocr_process_document.restype = ctypes.POINTER(OCRDocumentResultStruct)
+        
+        # ocr_process_document_memory(data, size, language, num_workers)
+        self.lib.ocr_process_document_memory.argtypes = [c_void_p, c_size_t, c_char_p, c_int]
+        self.lib.ocr_process_document_memory.restype = ctypes.POINTER(OCRDocumentResultStruct)
+        
+        # ocr_free_document_result(OCRDocumentResult* document)
+        self.lib.ocr_free_document_result.argtypes = [ctypes.POINTER(OCRDocumentResultStruct)]
+        
+        self.lib.ocr_process_stream.argtypes = [c_char_p, c_void_p, c_size_t, c_char_p, c_int, 
+                                                _STREAM_CALLBACK, c_void_p]
+        self.lib.ocr_process_stream.restype = c_int
+        self.lib.ocr_free_document_result.restype = None
+        
+        # ocr_get_cache_stats(OCRCacheStats* stats)
+        self.lib.ocr_get_cache_stats.argtypes = [ctypes.POINTER(OCRCacheStatsStruct)]
+        self.lib.ocr_get_cache_stats.restype = None
+        
+        # ocr_get_metrics(const char* format), freed with ocr_free_text
+        self.lib.ocr_get_metrics.argtypes = [c_char_p]
+        self.lib.ocr_get_metrics.restype = c_void_p
+        
+        # ocr_set_cache_backend(get, release, put, user_data)
+        self.lib.ocr_set_cache_backend.argtypes = [_CACHE_GET, _CACHE_RELEASE, _CACHE_PUT, c_void_p]
+        self.lib.ocr_set_cache_backend.restype = None
+        
+        # ocr_create_result(void), freed with ocr_free_result
+        self.lib.ocr_create_result.argtypes = []
+        self.lib.ocr_create_result.restype = ctypes.POINTER(OCRResultStruct)
+        
+        # ocr_process_memory_into(const unsigned char* data, size_t size, const char* language, OCRResult* result)
+        self.lib.ocr_process_memory_into.argtypes = [c_void_p, c_size_t, c_char_p, 
+                                                     ctypes.POINTER(OCRResultStruct)]
+        self.lib.ocr_process_memory_into.restype = c_int
+        
+        # ocr_preload(const char* languages, int copies)
+        self.lib.ocr_preload.argtypes = [c_char_p, c_int]
+        self.lib.ocr_preload.restype = c_int
+        
+        # ocr_recognize_fields(const unsigned char* data, size_t size, const char* language,
+        #                      const OCRFieldRegion* fields, int field_count, OCRFieldResult* results)
+        self.lib.ocr_recognize_fields.argtypes = [c_void_p, c_size_t, c_char_p, 
+                                                  ctypes.POINTER(OCRFieldRegionStruct), c_int, 
+                                                  ctypes.POINTER(OCRFieldResultStruct)]
+        self.lib.ocr_recognize_fields.restype = c_int
+    
+    def preload(self, languages: str, copies: int = 1) -> bool:
+        """Load engines for comma-separated combos ("fra+eng,eng") ahead of the first request"""
+        error = self.lib.ocr_preload(languages.encode('utf-8'), copies)
+        if error != 0:
+            logger.warning(f"⚠️ Preloading {languages} incomplete (error {error})")
+            return False
+        logger.info(f"✅ Preloaded OCR languages: {languages}")
+        return True
+    
+    def enable_redis_cache(self, url: str) -> bool:
+        """Share cached results through Redis; returns False if redis-py is missing"""
+        try:
+            cache = RedisResultCache(url, int(os.environ.get("OCR_CACHE_TTL", 7 * 24 * 3600)))
+        except ImportError:
+            logger.warning("⚠️ redis package not installed, result cache stays in-process")
+            return False
+        
+        cache.register(self.lib)
+        self.redis_cache = cache
+        logger.info("✅ OCR result cache shared through Redis")
+        return True
+    
+    def get_cache_stats(self) -> dict:
+        """Hit/miss counters and size of the result cache"""
+        stats = OCRCacheStatsStruct()
+        self.lib.ocr_get_cache_stats(ctypes.byref(stats))
+        return {name: getattr(stats, name) for name, _ in OCRCacheStatsStruct._fields_}
+    
+    def get_metrics(self, fmt: str = "prometheus") -> str:
+        """Library metrics as Prometheus text exposition or, with fmt="json", JSON"""
+        metrics_ptr = self.lib.ocr_get_metrics(fmt.encode('utf-8'))
+        if not metrics_ptr:
+            return ""
+        
+        try:
+            return ctypes.string_at(metrics_ptr).decode('utf-8')
+        finally:
+            self.lib.ocr_free_text(ctypes.cast(metrics_ptr, c_char_p))
+    
+    def __del__(self):
+        lib = getattr(self, "lib", None)
+        for result_ptr in getattr(self, "_result_pool", []):
+            lib.ocr_free_result(result_ptr)
+    
+    def _acquire_result(self):
+        with self._result_pool_lock:
+            if self._result_pool:
+                return self._result_pool.pop()
+        return self.lib.ocr_create_result()
+    
+    def _release_result(self, result_ptr):
+        with self._result_pool_lock:
+            self._result_pool.append(result_ptr)
+    
+    def _consume_result(self, result_ptr, source: str) -> Optional[dict]:
+        """Convert an OCRResult to a dict (text, confidences, words) and free it"""
+        if not result_ptr:
+            logger.error(f"❌ OCR failed for {source}")
+            return None
+        
+        try:
+            return self._read_result(result_ptr.contents, source)
+        finally:
+            self.lib.ocr_free_result(result_ptr)
+    
+    @staticmethod
+    def _read_result(result, source: str) -> Optional[dict]:
+        """Copy an OCRResult into a dict (text, confidences, words)"""
+        partial = result.error_code == OCR_ERROR_TIMEOUT
+        if (result.error_code != 0 and not partial) or not result.text:
+            message = result.error_message.decode('utf-8', errors='replace')
+            logger.error(f"❌ OCR failed for {source}: {message}")
+            return None
+        
+        def boxes(array, count):
+            return [{
+                "text": ctypes.string_at(array[i].text).decode('utf-8', errors='replace'),
+                "confidence": float(array[i].confidence),
+                "bbox": (array[i].left, array[i].top, array[i].right, array[i].bottom),
+            } for i in range(count)]
+        
+        words = boxes(result.words, result.word_box_count)
+        
+        details = {
+            "text": ctypes.string_at(result.text).decode('utf-8', errors='replace'),
+            "confidence": float(result.confidence),
+            "mean_confidence": float(result.mean_confidence),
+            "processing_time_ms": result.processing_time_ms,
+            "from_cache": bool(result.from_cache),
+            "language": result.language.decode('utf-8', errors='replace'),
+            "stage_ms": {stage: result.stage_ms[i] for i, stage in enumerate(OCR_STAGES)
+                         if result.stage_ms[i] > 0},
+            "words": words,
+        }
+        # Only present when the library was configured with outputs=hocr/tsv
+        if result.hocr:
+            details["hocr"] = ctypes.string_at(result.hocr).decode('utf-8', errors='replace')
+        if result.tsv:
+            details["tsv"] = ctypes.string_at(result.tsv).decode('utf-8', errors='replace')
+        if result.blocks:
+            details["blocks"] = boxes(result.blocks, result.block_count)
+        if partial:
+            details["timed_out"] = True
+            logger.warning(f"⚠️ OCR time budget exhausted for {source}, keeping partial text")
+        logger.info(f"✅ OCR completed for {source}: {len(details['text'])} characters, "
+                    f"{details['confidence']:.1f}% confidence, {result.processing_time_ms} ms")
+        return details
+    
+    @staticmethod
+    def _text_and_confidence(details: Optional[dict]) -> Tuple[str, float]:
+        if not details:
+            return "", 0.0
+        return details["text"], details["confidence"]
+    
+    def extract_details_from_file(self, file_path: str, language: str = "fra+eng") -> Optional[dict]:
+        """
+        Extract text, confidences and word boxes from an image file in one pass
+        
+        Returns:
+            Dict with text, confidence, mean_confidence, processing_time_ms and
+            words (text, confidence, bbox as (left, top, right, bottom)), plus
+            timed_out when the time budget cut recognition short, or None
+        """
+        result_ptr = self.lib.ocr_process_file_enhanced(file_path.encode('utf-8'), language.encode('utf-8'))
+        return self._consume_result(result_ptr, file_path)
     
     def extract_text_from_file(self, file_path: str, language: str = "fra+eng") -> Tuple[str, float]:
         """
@@ -71,28 +471,8 @@ class COCRWrapper:
             Tuple of (extracted_text, confidence_score)
         """
         try:
-            # Convert strings to bytes for C function
-            file_path_bytes = file_path.encode('utf-8')
-            language_bytes = language.encode('utf-8')
-            
-            # Call C function
-            result_ptr = self.lib.ocr_process_file(file_path_bytes, language_bytes)
-            
-            if result_ptr:
-                # Convert C string to Python string
-                text = result_ptr.decode('utf-8')
-                
-                # Get confidence score
-                confidence = self.lib.ocr_get_confidence(file_path_bytes, language_bytes)
-                
-                # Free C memory
-                self.lib.ocr_free_text(result_ptr)
-                
-                logger.info(f"✅ OCR completed for {file_path}: {len(text)} characters, {confidence:.1f}% confidence")
-                return text, float(confidence)
-            else:
-                logger.error(f"❌ OCR failed for {file_path}")
-                return "", 0.0
+            # Text and confidence come from the same recognition pass
+            return self._text_and_confidence(self.extract_details_from_file(file_path, language))
                 
         except Exception as e:
             logger.error(f"❌ Error in OCR processing: {e}")
@@ -100,36 +480,323 @@ class COCRWrapper:
     
     def extract_text_from_memory(self, image_data: bytes, language: str = "fra+eng") -> Tuple[str, float]:
         """
-        Extract text from image data in memory
+        Extract text from an encoded image (PNG, JPEG, TIFF, ...) in memory
+        
+        The buffer is handed to the C library without copying and goes
+        through the same preprocessing as file input.
         
         Args:
-            image_data: Raw image data as bytes
+            image_data: Encoded image as bytes, bytearray or memoryview
             language: Language codes
             
         Returns:
             Tuple of (extracted_text, confidence_score)
         """
         try:
-            # Convert bytes to ctypes array
-            data_array = (ctypes.c_ubyte * len(image_data)).from_buffer_copy(image_data)
-            language_bytes = language.encode('utf-8')
-            
-            # Call C function
-            result_ptr = self.lib.ocr_process_memory(data_array, len(image_data), language_bytes)
-            
-            if result_ptr:
-                text = result_ptr.decode('utf-8')
-                self.lib.ocr_free_text(result_ptr)
-                
-                logger.info(f"✅ OCR completed from memory: {len(text)} characters")
-                return text, 95.0  # Assume good confidence for memory processing
-            else:
-                logger.error("❌ OCR failed for memory data")
+            data, size = _buffer_pointer(image_data)
+            # Pooled results keep their word storage from one call to the next
+            result_ptr = self._acquire_result()
+            if not result_ptr:
                 return "", 0.0
+            try:
+                self.lib.ocr_process_memory_into(data, size, language.encode('utf-8'), result_ptr)
+                return self._text_and_confidence(self._read_result(result_ptr.contents, "memory data"))
+            finally:
+                self._release_result(result_ptr)
                 
         except Exception as e:
             logger.error(f"❌ Error in memory OCR processing: {e}")
             return "", 0.0
+    
+    def recognize_fields(self, image_data: bytes, fields: List[dict], 
+                         language: str = "fra+eng") -> Optional[List[dict]]:
+        """
+        Recognize only the given rectangles of an encoded image
+        
+        The image is decoded once at full scale without preprocessing, so the
+        boxes are in source pixels.
+        
+        Args:
+            image_data: Encoded image as bytes, bytearray or memoryview
+            fields: Dicts with "box" (left, top, width, height) and optionally
+                "charset" (digits, amount, date or literal characters) and
+                "psm" (Tesseract page segmentation mode, default single line)
+            language: Language codes
+            
+        Returns:
+            One dict per field with "text", "confidence" and "error_code", or
+            None when the image or the engine was unavailable
+        """
+        regions = (OCRFieldRegionStruct * len(fields))()
+        for region, field in zip(regions, fields):
+            region.left, region.top, region.width, region.height = field["box"]
+            charset = field.get("charset", "")
+            region.whitelist = OCR_FIELD_CHARSETS.get(charset, charset).encode('utf-8')[:127]
+            region.page_seg_mode = field.get("psm", 0)
+        
+        results = (OCRFieldResultStruct * len(fields))()
+        data, size = _buffer_pointer(image_data)
+        error = self.lib.ocr_recognize_fields(data, size, language.encode('utf-8'), 
+                                              regions, len(fields), results)
+        if error != 0:
+            logger.error(f"❌ Field recognition failed (error {error})")
+            return None
+        
+        return [{
+            "text": result.text.decode('utf-8', errors='replace'),
+            "confidence": result.confidence,
+            "error_code": result.error_code,
+        } for result in results]
+    
+    def extract_document(self, file_path: str = None, document_data: bytes = None,
+                         language: str = "fra+eng", workers: int = 0) -> Optional[List[Tuple[str, float]]]:
+        """
+        Extract text from every page of a PDF, multi-page TIFF or single image
+        
+        Pages are decoded in C and recognized concurrently.
+        
+        Args:
+            file_path: Path to the document (if processing a file)
+            document_data: Document bytes (if processing from memory)
+            language: Language codes
+            workers: Recognition threads, 0 for one per CPU
+            
+        Returns:
+            List of (page_text, confidence) in page order, or None if no page could be decoded
+        """
+        language_bytes = language.encode('utf-8')
+        if file_path:
+            document_ptr = self.lib.ocr_process_document(file_path.encode('utf-8'), language_bytes, workers)
+        else:
+            data, size = _buffer_pointer(document_data)
+            document_ptr = self.lib.ocr_process_document_memory(data, size, language_bytes, workers)
+        
+        if not document_ptr:
+            logger.error("❌ Document OCR failed")
+            return None
+        
+        try:
+            document = document_ptr.contents
+            pages = []
+            for i in range(document.page_count):
+                page_ptr = document.pages[i]
+                page = page_ptr.contents if page_ptr else None
+                if page and page.error_code == 0 and page.text:
+                    text = ctypes.string_at(page.text).decode('utf-8', errors='replace')
+                    pages.append((text, float(page.confidence)))
+                else:
+                    pages.append(("", 0.0))
+            
+            logger.info(f"✅ Document OCR completed: {document.success_count}/{document.page_count} pages, "
+                        f"{document.worker_count} workers, {document.total_time_ms} ms")
+            return pages
+        finally:
+            self.lib.ocr_free_document_result(document_ptr)
+    
+    def stream_document(self, file_path: str = None, document_data: bytes = None,
+                        language: str = "fra+eng", workers: int = 0) -> Iterator[dict]:
+        """
+        Yield the pages of a PDF, multi-page TIFF or single image as they are recognized
+        
+        Recognition runs on a background thread. Every page yields one event
+        {"page", "block": -1, "text", "confidence"} in page order, preceded by
+        one event per text block ("block" >= 0) when the library is configured
+        with outputs=blocks. Closing the generator early cancels the pages not
+        yet recognized.
+        """
+        events = queue.Queue()
+        stop = threading.Event()
+        finished = object()
+        
+        def on_event(user_data, event_ptr):
+            event = event_ptr.contents
+            events.put({
+                "page": event.page,
+                "block": event.block,
+                "text": event.text.decode('utf-8', errors='replace') if event.text else "",
+                "confidence": float(event.confidence),
+            })
+            return 1 if stop.is_set() else 0
+        
+        callback = _STREAM_CALLBACK(on_event)
+        if file_path:
+            path, data, size = file_path.encode('utf-8'), None, 0
+        else:
+            path = None
+            data, size = _buffer_pointer(document_data)
+        
+        def run():
+            error = -1
+            try:
+                error = self.lib.ocr_process_stream(path, data, size, language.encode('utf-8'), 
+                                                    workers, callback, None)
+            finally:
+                events.put((finished, error))
+        
+        worker = threading.Thread(target=run, daemon=True)
+        worker.start()
+        try:
+            while True:
+                event = events.get()
+                if isinstance(event, tuple) and event[0] is finished:
+                    if event[1] not in (0, OCR_ERROR_CANCELLED):
+                        logger.error(f"❌ Document stream failed (error {event[1]})")
+                    break
+                yield event
+        finally:
+            stop.set()
+            worker.join()
+    
+    def extract_text_from_pixels(self, pixels, width: int, height: int, stride: int = 0,
+                                 bits_per_pixel: int = 24, language: str = "fra+eng") -> Tuple[str, float]:
+        """
+        Extract text from raw pixel rows, skipping any encode/decode step
+        
+        Args:
+            pixels: 8-bit gray, 24-bit RGB or 32-bit RGBA rows
+            width, height: Image size in pixels
+            stride: Bytes per row, 0 for tightly packed rows
+            bits_per_pixel: 8, 24 or 32
+            language: Language codes
+            
+        Returns:
+            Tuple of (extracted_text, confidence_score)
+        """
+        try:
+            data, _ = _buffer_pointer(pixels)
+            result_ptr = self.lib.ocr_process_pixels_detailed(data, width, height, stride,
+                                                              bits_per_pixel, language.encode('utf-8'))
+            return self._text_and_confidence(self._consume_result(result_ptr, f"{width}x{height} pixel buffer"))
+                
+        except Exception as e:
+            logger.error(f"❌ Error in pixel OCR processing: {e}")
+            return "", 0.0
+    
+    def extract_text_from_image(self, image, language: str = "fra+eng") -> Tuple[str, float]:
+        """
+        Extract text from a PIL image (e.g. a pdf2image page)
+        
+        Args:
+            image: PIL.Image instance
+            language: Language codes
+            
+        Returns:
+            Tuple of (extracted_text, confidence_score)
+        """
+        modes = {"L": 8, "RGB": 24, "RGBA": 32}
+        if image.mode not in modes:
+            image = image.convert("RGB")
+        
+        return self.extract_text_from_pixels(image.tobytes(), image.width, image.height, 0,
+                                             modes[image.mode], language)
+
+
+class OCRServerClient:
+    """
+    Client of `ocr_cli serve`, the shared OCR daemon of a host
+    
+    Speaks the daemon's framing (big-endian u32 length, then u32 request id,
+    u32 config length, "key=value" config lines and the encoded image) over
+    a Unix socket ("unix:/path" or any path) or TCP ("host:port"). Requests
+    are pipelined: recognize_many writes every frame before reading the
+    answers, which the daemon returns in completion order.
+    """
+    
+    def __init__(self, address: str, timeout: float = 120.0):
+        self.address = address
+        self.timeout = timeout
+        self._socket = None
+        self._next_id = 1
+        self._lock = threading.Lock()
+    
+    def _connect(self):
+        import socket
+        
+        path = self.address[5:] if self.address.startswith("unix:") else (
+            self.address if "/" in self.address else None)
+        if path:
+            sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            sock.settimeout(self.timeout)
+            sock.connect(path)
+        else:
+            host, _, port = self.address.rpartition(":")
+            sock = socket.create_connection((host or "localhost", int(port)), timeout=self.timeout)
+        return sock
+    
+    def _read_exactly(self, size: int) -> bytes:
+        chunks = []
+        while size > 0:
+            chunk = self._socket.recv(min(size, 1 << 20))
+            if not chunk:
+                raise ConnectionError("OCR server closed the connection")
+            chunks.append(chunk)
+            size -= len(chunk)
+        return b"".join(chunks)
+    
+    def recognize_many(self, images: List[bytes], language: str = "fra+eng", **config) -> List[dict]:
+        """Results (see COCRWrapper.extract_details_from_file) in input order"""
+        import json
+        import socket
+        import struct
+        
+        settings = dict(config, language=language)
+        config_text = "".join(f"{key}={value}\n" for key, value in settings.items()).encode('utf-8')
+        
+        with self._lock:
+            if self._socket is None:
+                self._socket = self._connect()
+            
+            ids = []
+            for _ in images:
+                ids.append(self._next_id)
+                self._next_id = (self._next_id + 1) & 0xFFFFFFFF or 1
+            
+            # Requests go out from a second thread while this one reads, so a
+            # large batch never has both sides blocked on full socket buffers
+            send_errors = []
+            
+            def send_requests():
+                try:
+                    for request_id, image_data in zip(ids, images):
+                        header = struct.pack(">III", 8 + len(config_text) + len(image_data),
+                                             request_id, len(config_text))
+                        self._socket.sendall(header + config_text)
+                        self._socket.sendall(image_data)
+                except OSError as error:
+                    send_errors.append(error)
+            
+            sender = threading.Thread(target=send_requests, daemon=True)
+            sender.start()
+            try:
+                results = {}
+                while len(results) < len(ids):
+                    size, request_id = struct.unpack(">II", self._read_exactly(8))
+                    results[request_id] = json.loads(self._read_exactly(size - 4).decode('utf-8'))
+                sender.join()
+                if send_errors:
+                    raise send_errors[0]
+            except Exception:
+                # A half-read stream cannot be resynchronized; shutdown also
+                # wakes a sender blocked on the socket
+                try:
+                    self._socket.shutdown(socket.SHUT_RDWR)
+                except OSError:
+                    pass
+                sender.join()
+                self._socket.close()
+                self._socket = None
+                raise
+        
+        details = []
+        for request_id in ids:
+            result = results[request_id]
+            for word in result.get("words", []):
+                word["bbox"] = tuple(word["bbox"])
+            details.append(result)
+        return details
+    
+    def recognize(self, image_data: bytes, language: str = "fra+eng", **config) -> dict:
+        return self.recognize_many([image_data], language, **config)[0]
 
 
 class OCRFallback:
@@ -211,6 +878,12 @@ class CustomOCR:
         self.c_ocr = None
         self.fallback_ocr = OCRFallback()
         
+        # A shared `ocr_cli serve` daemon takes precedence over the in-process library
+        server_address = os.environ.get("OCR_SERVER")
+        self.server = OCRServerClient(server_address) if server_address else None
+        if self.server:
+            logger.info(f"🚀 Using OCR server at {server_address}")
+        
         # Try to load C library
         try:
             self.c_ocr = COCRWrapper()
@@ -220,28 +893,43 @@ class CustomOCR:
             logger.info("🔄 Will use fallback OCR")
     
     def extract_text(self, file_path: str = None, image_data: bytes = None, 
-                    language: str = "fra+eng") -> Tuple[str, float]:
+                    language: str = "fra+eng", image=None) -> Tuple[str, float]:
         """
-        Extract text from image file or data
+        Extract text from image file, encoded data or a PIL image
         
         Args:
             file_path: Path to image file (if processing file)
-            image_data: Raw image data (if processing from memory)
+            image_data: Encoded image data (if processing from memory)
             language: Language codes for OCR
+            image: PIL image (if processing decoded pixels)
             
         Returns:
             Tuple of (extracted_text, confidence_score)
         """
+        if self.server:
+            try:
+                return self._extract_text_with_server(file_path, image_data, language, image)
+            except Exception as e:
+                logger.warning(f"⚠️ OCR server failed, trying the in-process library: {e}")
+        
         # Try C library first
         if self.c_ocr:
             try:
                 if file_path:
                     return self.c_ocr.extract_text_from_file(file_path, language)
+                elif image is not None:
+                    return self.c_ocr.extract_text_from_image(image, language)
                 elif image_data:
                     return self.c_ocr.extract_text_from_memory(image_data, language)
             except Exception as e:
                 logger.warning(f"⚠️ C OCR failed, trying fallback: {e}")
         
+        # The CLI fallback needs encoded bytes
+        if image is not None and not file_path and not image_data:
+            buffer = io.BytesIO()
+            image.save(buffer, format='PNG')
+            image_data = buffer.getvalue()
+        
         # Fallback to CLI tesseract
         if file_path and self.fallback_ocr.tesseract_available:
             return self.fallback_ocr.extract_text_from_file(file_path, language)
@@ -261,6 +949,93 @@ class CustomOCR:
         
         logger.error("❌ No OCR method available")
         return "", 0.0
+    
+    def _extract_text_with_server(self, file_path, image_data, language, image) -> Tuple[str, float]:
+        if file_path:
+            with open(file_path, 'rb') as f:
+                image_data = f.read()
+        elif image is not None:
+            buffer = io.BytesIO()
+            image.save(buffer, format='PNG')
+            image_data = buffer.getvalue()
+        
+        result = self.server.recognize(bytes(image_data), language)
+        if result["error_code"] != 0:
+            raise RuntimeError(result["error"])
+        return result["text"], float(result["confidence"])
+    
+    def extract_details(self, file_path: str, language: str = "fra+eng") -> Optional[dict]:
+        """
+        Text, confidences and per-word boxes from one recognition pass
+        
+        Returns:
+            See COCRWrapper.extract_details_from_file; None when the C library
+            is unavailable or OCR failed
+        """
+        if not self.c_ocr:
+            return None
+        
+        try:
+            return self.c_ocr.extract_details_from_file(file_path, language)
+        except Exception as e:
+            logger.warning(f"⚠️ C OCR failed: {e}")
+            return None
+    
+    def extract_fields(self, image_data: bytes, fields: List[dict], 
+                       language: str = "fra+eng") -> Optional[List[dict]]:
+        """
+        Text of known regions (amounts, dates, references) without whole-page OCR
+        
+        Returns:
+            See COCRWrapper.recognize_fields; None when the C library is
+            unavailable or the image could not be decoded
+        """
+        if not self.c_ocr:
+            return None
+        
+        try:
+            return self.c_ocr.recognize_fields(image_data, fields, language)
+        except Exception as e:
+            logger.warning(f"⚠️ C field OCR failed: {e}")
+            return None
+    
+    def extract_document(self, file_path: str = None, document_data: bytes = None,
+                         language: str = "fra+eng", workers: int = 0) -> Optional[List[Tuple[str, float]]]:
+        """
+        Extract text from every page of a multi-page document with the C library
+        
+        Returns:
+            List of (page_text, confidence) in page order, or None when the C
+            library is unavailable or could not decode the document
+        """
+        if not self.c_ocr:
+            return None
+        
+        try:
+            return self.c_ocr.extract_document(file_path, document_data, language, workers)
+        except Exception as e:
+            logger.warning(f"⚠️ C document OCR failed: {e}")
+            return None
+    
+    def stream_document(self, file_path: str = None, document_data: bytes = None,
+                        language: str = "fra+eng", workers: int = 0) -> Optional[Iterator[dict]]:
+        """
+        Page and block events of a multi-page document as they are recognized
+        
+        Returns:
+            See COCRWrapper.stream_document; None when the C library is unavailable
+        """
+        if not self.c_ocr:
+            return None
+        return self.c_ocr.stream_document(file_path, document_data, language, workers)
+    
+    def get_cache_stats(self) -> Optional[dict]:
+        """Result cache counters of the C library, None when it is not loaded"""
+        return self.c_ocr.get_cache_stats() if self.c_ocr else None
+    
+    def get_metrics(self, fmt: str = "prometheus") -> Optional[str]:
+        """Metrics export of the C library, None when it is not loaded"""
+        return self.c_ocr.get_metrics(fmt) if self.c_ocr else None
 
 
 # Test function
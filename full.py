@@ -10,7 +10,7 @@ import time
 from pdf2image import convert_from_bytes
 from fastapi import FastAPI, UploadFile, File, HTTPException, Form
 from fastapi.staticfiles import StaticFiles
-from fastapi.responses import HTMLResponse
+from fastapi.responses import HTMLResponse, PlainTextResponse, StreamingResponse
 from fastapi.templating import Jinja2Templates
 from fastapi.requests import Request
 from jinja2 import Template
@@ -207,11 +207,32 @@ def extract_text_with_custom_ocr(file_content, filename):
     """Extract text from image/PDF using custom C-based OCR"""
     try:
         # Check if the file is a PDF
-        if filename.lower().endswith('.pdf'):
+        is_pdf = filename.lower().endswith('.pdf')
+        
+        # Rasterize and recognize all pages concurrently in the C library,
+        # receiving each page as soon as it is recognized
+        events = custom_ocr.stream_document(document_data=file_content) if is_pdf else None
+        
+        if events is not None:
+            all_text = []
+            page_count = 0
+            for event in events:
+                if event["block"] != -1:
+                    continue
+                page_count += 1
+                print(f"✅ Page {event['page'] + 1} recognized: {len(event['text'])} characters")
+                if event["text"].strip():
+                    all_text.append(event["text"])
+            print(f"📄 PDF processed natively: {page_count} page(s)")
+            if not all_text:
+                return "No text found in PDF."
+            raw_text = "\n\n--- PAGE BREAK ---\n\n".join(all_text)
+        
+        elif is_pdf:
             print("🔄 Converting PDF to images...")
             try:
                 # Convert PDF to images
-                images = convert_from_bytes(file_content, dpi=300, fmt='PNG')
+                images = convert_from_bytes(file_content, dpi=300, fmt='ppm')
                 print(f"📄 PDF converted to {len(images)} image(s)")
                 
                 all_text = []
@@ -220,28 +241,13 @@ def extract_text_with_custom_ocr(file_content, filename):
                 for i, img in enumerate(images):
                     print(f"🔍 Processing page {i+1}/{len(images)}...")
                     
-                    # Convert PIL image to bytes
-                    img_byte_arr = io.BytesIO()
-                    img.save(img_byte_arr, format='PNG')
-                    img_bytes = img_byte_arr.getvalue()
-                    
-                    # Save temp image file for OCR processing
-                    temp_filename = f"temp_page_{i+1}.png"
-                    with open(temp_filename, 'wb') as temp_file:
-                        temp_file.write(img_bytes)
-                    
-                    try:
-                        # Process with custom OCR
-                        page_text = custom_ocr.extract_text(temp_filename)
-                        if page_text and page_text.strip():
-                            all_text.append(page_text)
-                            print(f"✅ Extracted text from page {i+1}: {len(page_text)} characters")
-                        else:
-                            print(f"⚠️ No text found on page {i+1}")
-                    finally:
-                        # Clean up temp file
-                        if os.path.exists(temp_filename):
-                            os.remove(temp_filename)
+                    # Hand the decoded page pixels straight to the OCR library
+                    page_text, _ = custom_ocr.extract_text(image=img)
+                    if page_text and page_text.strip():
+                        all_text.append(page_text)
+                        print(f"✅ Extracted text from page {i+1}: {len(page_text)} characters")
+                    else:
+                        print(f"⚠️ No text found on page {i+1}")
                 
                 if not all_text:
                     return "No text found in PDF."
@@ -257,20 +263,10 @@ def extract_text_with_custom_ocr(file_content, filename):
             # Handle image files directly
             print("🔍 Processing image file...")
             
-            # Save temp image file for OCR processing
-            temp_filename = f"temp_image_{int(time.time())}.{filename.split('.')[-1]}"
-            with open(temp_filename, 'wb') as temp_file:
-                temp_file.write(file_content)
-            
-            try:
-                # Process with custom OCR
-                raw_text = custom_ocr.extract_text(temp_filename)
-                if not raw_text or not raw_text.strip():
-                    return "No text found."
-            finally:
-                # Clean up temp file
-                if os.path.exists(temp_filename):
-                    os.remove(temp_filename)
+            # Decode the upload straight from memory
+            raw_text, _ = custom_ocr.extract_text(image_data=file_content)
+            if not raw_text or not raw_text.strip():
+                return "No text found."
         
         # Clean the extracted text
         cleaned_text = clean_text(raw_text)
@@ -1091,6 +1087,34 @@ TEXTE DE LA FACTURE STRUCTURÉ LIGNE PAR LIGNE (totaux marqués avec >>> <<<):
 async def simple_test():
     return {"status": "working", "message": "API is running"}
 
+# OCR metrics for Prometheus scraping; ?format=json for a JSON snapshot
+@app.get("/metrics")
+async def ocr_metrics(format: str = "prometheus"):
+    metrics = custom_ocr.get_metrics(format)
+    if metrics is None:
+        raise HTTPException(status_code=503, detail="C OCR library not loaded")
+    
+    if format == "json":
+        return json.loads(metrics)
+    return PlainTextResponse(metrics, media_type="text/plain; version=0.0.4")
+
+# Streams OCR of an uploaded document as NDJSON, one line per recognized page
+# (and per text block when the library runs with outputs=blocks), so clients
+# can start on page 1 while later pages are still being recognized
+@app.post("/ocr-stream/")
+async def ocr_stream(file: UploadFile = File(...)):
+    content = await file.read()
+    events = custom_ocr.stream_document(document_data=content)
+    if events is None:
+        raise HTTPException(status_code=503, detail="C OCR library not loaded")
+    
+    def lines():
+        for event in events:
+            event["text"] = clean_text(event["text"])
+            yield json.dumps(event, ensure_ascii=False) + "\n"
+    
+    return StreamingResponse(lines(), media_type="application/x-ndjson")
+
 # Test total detection endpoint
 @app.post("/test-totals/")
 async def test_total_detection_endpoint(request: Request):